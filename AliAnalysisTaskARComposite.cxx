@@ -0,0 +1,592 @@
+/**
+ * File              : AliAnalysisTaskARComposite.cxx
+ * Author            : Anton Riedel <anton.riedel@tum.de>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+ */
+
+#include "AliAnalysisTaskARComposite.h"
+
+#include "AliAODEvent.h"
+#include "AliAODTrack.h"
+#include "AliAODVertex.h"
+#include "AliAnalysisManager.h"
+#include "AliLog.h"
+#include "AliMultSelection.h"
+
+#include <algorithm>
+#include <cmath>
+
+ClassImp(AliAnalysisTaskARComposite)
+
+AliAnalysisTaskARComposite::AliAnalysisTaskARComposite()
+    : AliAnalysisTaskSE(), fCentralityEstimator("V0M"), fFilterBit(128),
+      fDCAxyMax(3.2), fDCAzMax(2.4), fFixedMultiplicity(0),
+      fNestedLoopsThreads(1), fSkimWriter(nullptr), fNestedLoops(nullptr) {
+  // dummy constructor, only used for I/O
+  SetDefaultCuts(128, 0., 100.);
+  for (Int_t k = 0; k < LAST_EKINEMATIC; k++) {
+    fWeightHistograms[k] = nullptr;
+  }
+#ifdef ARCOMPOSITE_TIMING
+  fLastEventEnd = 0;
+#endif
+}
+
+AliAnalysisTaskARComposite::AliAnalysisTaskARComposite(const char *name)
+    : AliAnalysisTaskSE(name), fCentralityEstimator("V0M"), fFilterBit(128),
+      fDCAxyMax(3.2), fDCAzMax(2.4), fFixedMultiplicity(0),
+      fNestedLoopsThreads(1), fSkimWriter(nullptr), fNestedLoops(nullptr) {
+  // output slots are defined when variants are added
+  SetDefaultCuts(128, 0., 100.);
+  for (Int_t k = 0; k < LAST_EKINEMATIC; k++) {
+    fWeightHistograms[k] = nullptr;
+  }
+#ifdef ARCOMPOSITE_TIMING
+  fLastEventEnd = 0;
+#endif
+}
+
+AliAnalysisTaskARComposite::~AliAnalysisTaskARComposite() {
+  delete fSkimWriter;
+  delete fNestedLoops;
+  // output lists are owned by the analysis manager when running in proof
+  if (AliAnalysisManager::GetAnalysisManager() &&
+      AliAnalysisManager::GetAnalysisManager()->IsProofMode()) {
+    return;
+  }
+  for (auto list : fVariantOutputs) {
+    delete list;
+  }
+}
+
+Int_t AliAnalysisTaskARComposite::AddVariant(const char *name,
+                                             Double_t centralityMin,
+                                             Double_t centralityMax,
+                                             Bool_t useNestedLoops,
+                                             Bool_t useWeights) {
+  // output slot 0 is reserved for the AOD tree of AliAnalysisTaskSE
+  fVariantNames.push_back(name);
+  fVariantCentralityMin.push_back(centralityMin);
+  fVariantCentralityMax.push_back(centralityMax);
+  fVariantUseNestedLoops.push_back(useNestedLoops);
+  fVariantUseWeights.push_back(useWeights);
+  Int_t slot = fVariantNames.size();
+  DefineOutput(slot, TList::Class());
+  return slot;
+}
+
+void AliAnalysisTaskARComposite::SetDefaultCuts(Int_t filterBit,
+                                                Double_t centralityMin,
+                                                Double_t centralityMax) {
+  // same values as AliAnalysisTaskAR::SetDefaultCuts of ALIPHYSICS_TAG, see
+  // GridConfig.sh, AddTaskComposite in AddTask.C sets all of them explicitly
+  // and ValidateComposite.C compares the results of both tasks
+  fFilterBit = filterBit;
+  SetCentralityRange(centralityMin, centralityMax);
+  SetPrimaryVertexZRange(-10., 10.);
+  SetNContributorsMin(1);
+  SetPtRange(0.2, 5.);
+  SetEtaRange(-0.8, 0.8);
+  SetTPCClustersRange(70, 160);
+  SetChi2PerNDFRange(0.1, 4.);
+  SetDCAxyMax(3.2);
+  SetDCAzMax(2.4);
+}
+
+void AliAnalysisTaskARComposite::UserCreateOutputObjects() {
+  // create one output list per variant
+  // all variants share the same binning, so their outputs can be compared
+  // bin by bin
+
+  CreateWeightTables();
+  fCorrelatorSet.SetCorrelators(fCorrelators);
+  // threads for nested loops are started once and reused for all events
+  delete fNestedLoops;
+  fNestedLoops = new CorrelatorEngine::NestedLoopsEngine(fNestedLoopsThreads);
+
+  if (!fSkimFile.IsNull()) {
+    // a job asked to write a skim fails, if it cannot write it
+    fSkimWriter = new ColumnarSkim::Writer();
+    if (!fSkimWriter->Open(fSkimFile)) {
+      AliFatal(Form("Cannot open skim file %s", fSkimFile.Data()));
+    }
+  }
+
+  fVariantOutputs.clear();
+  fVariantCentrality.clear();
+  fVariantMultiplicity.clear();
+  fVariantCorrelators.clear();
+#ifdef ARCOMPOSITE_TIMING
+  std::fill(fSharedTime, fSharedTime + LAST_EPHASE, 0);
+  std::fill(fSharedCalls, fSharedCalls + LAST_EPHASE, 0);
+  fVariantTime.assign(fVariantNames.size(), {});
+  fVariantCalls.assign(fVariantNames.size(), {});
+  fVariantPhaseTime.clear();
+  fVariantPhaseCalls.clear();
+  fVariantTimeVsMultiplicity.clear();
+#endif
+  for (std::size_t v = 0; v < fVariantNames.size(); v++) {
+    TList *list = new TList();
+    list->SetName(fVariantNames.at(v));
+    list->SetOwner(kTRUE);
+
+    TH1D *centrality =
+        new TH1D("Centrality", "Centrality;centrality percentile;events", 100,
+                 0., 100.);
+    list->Add(centrality);
+    fVariantCentrality.push_back(centrality);
+    TH1D *multiplicity = new TH1D(
+        "Multiplicity", "Multiplicity;selected tracks;events", 5000, 0., 5000.);
+    list->Add(multiplicity);
+    fVariantMultiplicity.push_back(multiplicity);
+
+    Int_t nCorrelators = fCorrelators.size();
+    TProfile *correlators =
+        new TProfile("Correlators",
+                     fVariantUseNestedLoops.at(v)
+                         ? "Correlators (nested loops)"
+                         : "Correlators (Q-vectors)",
+                     nCorrelators, 0., nCorrelators);
+    correlators->Sumw2();
+    for (Int_t c = 0; c < nCorrelators; c++) {
+      TString label("{");
+      for (std::size_t h = 0; h < fCorrelators.at(c).size(); h++) {
+        label += Form(h == 0 ? "%d" : ",%d", fCorrelators.at(c).at(h));
+      }
+      label += "}";
+      correlators->GetXaxis()->SetBinLabel(c + 1, label);
+    }
+    list->Add(correlators);
+    fVariantCorrelators.push_back(correlators);
+
+#ifdef ARCOMPOSITE_TIMING
+    // time in ns and calls per phase, summed over all events, filled once in
+    // FinishTaskOutput
+    TH1D *phaseTime = new TH1D("PhaseTime", "PhaseTime;;time (ns)",
+                               LAST_EPHASE, 0., LAST_EPHASE);
+    TH1D *phaseCalls = new TH1D("PhaseCalls", "PhaseCalls;;calls",
+                                LAST_EPHASE, 0., LAST_EPHASE);
+    for (Int_t p = 0; p < LAST_EPHASE; p++) {
+      phaseTime->GetXaxis()->SetBinLabel(p + 1, GetPhaseName(Phase(p)));
+      phaseCalls->GetXaxis()->SetBinLabel(p + 1, GetPhaseName(Phase(p)));
+    }
+    list->Add(phaseTime);
+    list->Add(phaseCalls);
+    fVariantPhaseTime.push_back(phaseTime);
+    fVariantPhaseCalls.push_back(phaseCalls);
+    // time per event on a logarithmic axis from 0.1 us to 1 s
+    std::vector<Double_t> timeBins;
+    for (Int_t i = 0; i <= 70; i++) {
+      timeBins.push_back(std::pow(10., -1. + i / 10.));
+    }
+    TH2D *timeVsMultiplicity = new TH2D(
+        "TimeVsMultiplicity",
+        "TimeVsMultiplicity;selected tracks;time per event (#mus)", 250, 0.,
+        5000., timeBins.size() - 1, timeBins.data());
+    list->Add(timeVsMultiplicity);
+    fVariantTimeVsMultiplicity.push_back(timeVsMultiplicity);
+#endif
+
+    fVariantOutputs.push_back(list);
+    PostData(v + 1, list);
+  }
+}
+
+void AliAnalysisTaskARComposite::UserExec(Option_t *) {
+  // Body:
+  // a) Event variables;
+  // b) Write skim if requested;
+  // c) Event cuts, done once for all variants;
+  // d) Track selection, done once for all variants;
+  // e) Fan out the selected tracks to all variants.
+
+  AliAODEvent *aod = dynamic_cast<AliAODEvent *>(InputEvent());
+  if (!aod) {
+    return;
+  }
+
+  // a) Event variables:
+  // centrality from AliMultSelectionTask
+  AliMultSelection *multSelection =
+      dynamic_cast<AliMultSelection *>(aod->FindListObject("MultSelection"));
+  AliAODVertex *vertex = aod->GetPrimaryVertex();
+  if (!multSelection || !vertex) {
+    return;
+  }
+  Double_t centrality =
+      multSelection->GetMultiplicityPercentile(fCentralityEstimator);
+
+  // b) Write skim if requested:
+  if (fSkimWriter) {
+    WriteSkimEvent(aod, centrality, vertex->GetZ(),
+                   vertex->GetNContributors());
+  }
+
+  // c) Event cuts, done once for all variants:
+  // everything up to here since the last event counts as I/O
+  BeginEvent();
+  Long64_t start = StartTimer();
+  Bool_t survive = SurviveEventCut(centrality, vertex->GetZ(),
+                                   vertex->GetNContributors());
+  StopTimer(kEVENTCUTS, start);
+  if (!survive) {
+    EndEvent();
+    return;
+  }
+
+  // d) Track selection, done once for all variants:
+  start = StartTimer();
+  FillSelectedTracks(aod);
+  StopTimer(kTRACKCUTS, start);
+
+  // e) Fan out the selected tracks to all variants:
+  ProcessSelectedTracks(centrality);
+  EndEvent();
+}
+
+void AliAnalysisTaskARComposite::ProcessSkimEvent(
+    const ColumnarSkim::EventView &event) {
+  // same as UserExec, but all variables are read from the skim
+
+  BeginEvent();
+  Long64_t start = StartTimer();
+  Bool_t survive =
+      SurviveEventCut(event.Centrality, event.VertexZ, event.NContributors);
+  StopTimer(kEVENTCUTS, start);
+  if (!survive) {
+    EndEvent();
+    return;
+  }
+
+  start = StartTimer();
+  fSelectedTracks.Clear();
+  fSelectedTracks.Reserve(event.NTracks);
+  for (Int_t i = 0; i < event.NTracks; i++) {
+    if (!SurviveTrackCut(event.FilterMap[i], event.Pt[i], event.Eta[i],
+                         event.TPCClusters[i], event.Chi2PerNDF[i],
+                         event.DCAxy[i], event.DCAz[i], event.Charge[i])) {
+      continue;
+    }
+    fSelectedTracks.AddTrack(event.Phi[i], event.Pt[i], event.Eta[i]);
+    if (fFixedMultiplicity > 0 &&
+        fSelectedTracks.GetMultiplicity() == fFixedMultiplicity) {
+      break;
+    }
+  }
+  StopTimer(kTRACKCUTS, start);
+
+  ProcessSelectedTracks(event.Centrality);
+  EndEvent();
+}
+
+void AliAnalysisTaskARComposite::ProcessSelectedTracks(Double_t centrality) {
+  // Body:
+  // a) Check multiplicity;
+  // b) Fan out the selected tracks to all variants in this centrality bin;
+  // c) Post outputs.
+
+  // a) Check multiplicity:
+  Int_t M = fSelectedTracks.GetMultiplicity();
+  if (fFixedMultiplicity > 0) {
+    if (M < fFixedMultiplicity) {
+      return;
+    }
+    M = fFixedMultiplicity;
+  }
+
+  // b) Fan out the selected tracks to all variants in this centrality bin:
+  // variants with the same method and weights share their results, so every
+  // combination is computed at most once per event
+  for (Int_t n = 0; n < 2; n++) {
+    for (Int_t w = 0; w < 2; w++) {
+      fResultsValid[n][w] = kFALSE;
+    }
+  }
+  Bool_t weightsFilled = kFALSE;
+  for (std::size_t v = 0; v < fVariantNames.size(); v++) {
+    if (centrality < fVariantCentralityMin.at(v) ||
+        centrality >= fVariantCentralityMax.at(v)) {
+      continue;
+    }
+    Bool_t useNestedLoops = fVariantUseNestedLoops.at(v);
+    Bool_t useWeights = fVariantUseWeights.at(v);
+    if (useWeights && !weightsFilled) {
+      Long64_t start = StartTimer();
+      FillWeights();
+      StopTimer(kWEIGHTS, start);
+      weightsFilled = kTRUE;
+    }
+    if (!fResultsValid[useNestedLoops][useWeights]) {
+      ComputeCorrelators(useNestedLoops, useWeights);
+      fResultsValid[useNestedLoops][useWeights] = kTRUE;
+    }
+
+#ifdef ARCOMPOSITE_TIMING
+    Long64_t start = Now();
+#endif
+    fVariantCentrality.at(v)->Fill(centrality);
+    fVariantMultiplicity.at(v)->Fill(M);
+    TProfile *correlators = fVariantCorrelators.at(v);
+    const auto &results = fResults[useNestedLoops][useWeights];
+    for (std::size_t c = 0; c < results.size(); c++) {
+      if (results.at(c).Weight > 0.) {
+        correlators->Fill(c + 0.5, results.at(c).Value, results.at(c).Weight);
+      }
+    }
+
+#ifdef ARCOMPOSITE_TIMING
+    // phases this variant needed in this event, the phases shared by all
+    // variants are summed in EndEvent
+    Long64_t histogramTime = Now() - start;
+    std::array<Long64_t, LAST_EPHASE> &time = fVariantTime[v];
+    std::array<Long64_t, LAST_EPHASE> &calls = fVariantCalls[v];
+    time[kHISTOGRAMS] += histogramTime;
+    calls[kHISTOGRAMS]++;
+    Long64_t eventTime = histogramTime;
+    for (Int_t p = 0; p < kWEIGHTS; p++) {
+      eventTime += fEventTime[p];
+    }
+    if (useWeights) {
+      time[kWEIGHTS] += fEventTime[kWEIGHTS];
+      calls[kWEIGHTS] += fEventCalls[kWEIGHTS];
+      eventTime += fEventTime[kWEIGHTS];
+    }
+    for (Int_t p = kQFILL; p <= kNESTEDLOOPS; p++) {
+      time[p] += fCombinationTime[useNestedLoops][useWeights][p];
+      calls[p] += fCombinationCalls[useNestedLoops][useWeights][p];
+      eventTime += fCombinationTime[useNestedLoops][useWeights][p];
+    }
+    fVariantTimeVsMultiplicity[v]->Fill(M, 1e-3 * eventTime);
+#endif
+  }
+
+  // c) Post outputs:
+  for (std::size_t v = 0; v < fVariantOutputs.size(); v++) {
+    PostData(v + 1, fVariantOutputs.at(v));
+  }
+}
+
+void AliAnalysisTaskARComposite::FinishTaskOutput() {
+  // fill the timing and close the skim on the worker, after the last event
+  FillTiming();
+  if (fSkimWriter && !fSkimWriter->Close()) {
+    AliFatal(Form("Writing skim file %s failed", fSkimFile.Data()));
+  }
+}
+
+void AliAnalysisTaskARComposite::Terminate(Option_t *) {
+  // nothing to be done, all results are in the output lists
+}
+
+Bool_t AliAnalysisTaskARComposite::SurviveEventCut(Double_t centrality,
+                                                   Double_t vertexZ,
+                                                   Int_t nContributors) {
+  if (centrality < fCentralityRange[0] || centrality >= fCentralityRange[1]) {
+    return kFALSE;
+  }
+  if (nContributors < fNContributorsMin) {
+    return kFALSE;
+  }
+  if (vertexZ < fPrimaryVertexZRange[0] || vertexZ > fPrimaryVertexZRange[1]) {
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+Bool_t AliAnalysisTaskARComposite::SurviveTrackCut(
+    UInt_t filterMap, Double_t pt, Double_t eta, Int_t tpcClusters,
+    Double_t chi2PerNDF, Double_t dcaXY, Double_t dcaZ, Int_t charge) {
+  // same as AliAODTrack::TestFilterBit
+  if ((filterMap & fFilterBit) == 0) {
+    return kFALSE;
+  }
+  if (pt < fPtRange[0] || pt > fPtRange[1] || eta < fEtaRange[0] ||
+      eta > fEtaRange[1]) {
+    return kFALSE;
+  }
+  if (tpcClusters < fTPCClustersRange[0] ||
+      tpcClusters > fTPCClustersRange[1]) {
+    return kFALSE;
+  }
+  if (chi2PerNDF < fChi2PerNDFRange[0] || chi2PerNDF > fChi2PerNDFRange[1]) {
+    return kFALSE;
+  }
+  if (std::abs(dcaXY) > fDCAxyMax || std::abs(dcaZ) > fDCAzMax) {
+    return kFALSE;
+  }
+  if (charge == 0) {
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+void AliAnalysisTaskARComposite::FillSelectedTracks(AliAODEvent *aod) {
+  // fill all tracks surviving the track cuts into the shared buffer
+  // weights are set to 1 and only filled if a weighted variant needs them
+  Int_t nTracks = aod->GetNumberOfTracks();
+  fSelectedTracks.Clear();
+  fSelectedTracks.Reserve(nTracks);
+
+  for (Int_t i = 0; i < nTracks; i++) {
+    AliAODTrack *track = dynamic_cast<AliAODTrack *>(aod->GetTrack(i));
+    if (!track ||
+        !SurviveTrackCut(track->GetFilterMap(), track->Pt(), track->Eta(),
+                         track->GetTPCNcls(), track->Chi2perNDF(),
+                         track->DCA(), track->ZAtDCA(), track->Charge())) {
+      continue;
+    }
+    fSelectedTracks.AddTrack(track->Phi(), track->Pt(), track->Eta());
+
+    if (fFixedMultiplicity > 0 &&
+        fSelectedTracks.GetMultiplicity() == fFixedMultiplicity) {
+      break;
+    }
+  }
+}
+
+void AliAnalysisTaskARComposite::WriteSkimEvent(AliAODEvent *aod,
+                                                Double_t centrality,
+                                                Double_t vertexZ,
+                                                Int_t nContributors) {
+  // the skim is preselected with the centrality range and the filter bit,
+  // all other cuts are applied again when reading it
+  if (centrality < fCentralityRange[0] || centrality >= fCentralityRange[1]) {
+    return;
+  }
+  fSkimWriter->AddEvent(centrality, vertexZ, nContributors);
+  for (Int_t i = 0; i < aod->GetNumberOfTracks(); i++) {
+    AliAODTrack *track = dynamic_cast<AliAODTrack *>(aod->GetTrack(i));
+    if (!track || !track->TestFilterBit(fFilterBit)) {
+      continue;
+    }
+    fSkimWriter->AddTrack(track->GetFilterMap(), track->Phi(), track->Pt(),
+                          track->Eta(), track->Charge(), track->GetTPCNcls(),
+                          track->Chi2perNDF(), track->DCA(), track->ZAtDCA());
+  }
+  // a block is written when the next event is added, stop right away if
+  // that failed
+  if (!fSkimWriter->IsGood()) {
+    AliFatal(Form("Writing skim file %s failed", fSkimFile.Data()));
+  }
+}
+
+void AliAnalysisTaskARComposite::CreateWeightTables() {
+  // turn the weight histograms into lookup tables, so no TH1 is touched per
+  // track anymore
+  for (Int_t k = 0; k < LAST_EKINEMATIC; k++) {
+    fWeightTables[k] = CorrelatorEngine::WeightTable();
+    if (!fWeightHistograms[k]) {
+      continue;
+    }
+    const TAxis *axis = fWeightHistograms[k]->GetXaxis();
+    Int_t nbins = axis->GetNbins();
+    std::vector<Double_t> contents(nbins + 2);
+    for (Int_t bin = 0; bin <= nbins + 1; bin++) {
+      contents.at(bin) = fWeightHistograms[k]->GetBinContent(bin);
+    }
+    if (axis->GetXbins()->GetSize() == 0) {
+      fWeightTables[k].SetFixedBins(nbins, axis->GetXmin(), axis->GetXmax(),
+                                    contents.data());
+    } else {
+      std::vector<Double_t> edges(axis->GetXbins()->GetArray(),
+                                  axis->GetXbins()->GetArray() + nbins + 1);
+      fWeightTables[k].SetVariableBins(edges, contents.data());
+    }
+  }
+}
+
+void AliAnalysisTaskARComposite::FillWeights() {
+  // particle weight is the product of the phi, pt and eta weights, computed
+  // in batches over all selected tracks
+  Int_t M = fSelectedTracks.GetMultiplicity();
+  const Double_t *kinematics[LAST_EKINEMATIC] = {fSelectedTracks.Phi.data(),
+                                                 fSelectedTracks.Pt.data(),
+                                                 fSelectedTracks.Eta.data()};
+  std::fill(fSelectedTracks.Weight.begin(), fSelectedTracks.Weight.end(), 1.);
+  for (Int_t k = 0; k < LAST_EKINEMATIC; k++) {
+    if (!fWeightTables[k].IsEmpty()) {
+      fWeightTables[k].Multiply(kinematics[k], M,
+                                fSelectedTracks.Weight.data());
+    }
+  }
+}
+
+void AliAnalysisTaskARComposite::ComputeCorrelators(Bool_t useNestedLoops,
+                                                    Bool_t useWeights) {
+  // compute all correlators for one combination of method and weights
+  std::vector<CorrelatorEngine::Result> &results =
+      fResults[useNestedLoops][useWeights];
+  results.resize(fCorrelators.size());
+
+  if (useNestedLoops) {
+    Long64_t start = StartTimer();
+    for (std::size_t c = 0; c < fCorrelators.size(); c++) {
+      results.at(c) = fNestedLoops->Compute(fSelectedTracks, fCorrelators.at(c),
+                                            useWeights);
+    }
+    StopTimer(kNESTEDLOOPS, start, useNestedLoops, useWeights);
+    return;
+  }
+
+  // fill the Q-vectors needed by any correlator in a single pass and
+  // evaluate the shared sub-terms of all correlators once
+  Long64_t start = StartTimer();
+  fCorrelatorSet.FillQVectors(fSelectedTracks, useWeights);
+  StopTimer(kQFILL, start, useNestedLoops, useWeights);
+  start = StartTimer();
+  fCorrelatorSet.Evaluate();
+  for (std::size_t c = 0; c < fCorrelators.size(); c++) {
+    results.at(c) = fCorrelatorSet.GetResult(c);
+  }
+  StopTimer(kCORRELATORS, start, useNestedLoops, useWeights);
+}
+
+#ifdef ARCOMPOSITE_TIMING
+void AliAnalysisTaskARComposite::BeginEvent() {
+  // reset the counters of the last event, the time since the end of the last
+  // event counts as I/O
+  Long64_t now = Now();
+  std::fill(fEventTime, fEventTime + LAST_EPHASE, 0);
+  std::fill(fEventCalls, fEventCalls + LAST_EPHASE, 0);
+  std::fill(&fCombinationTime[0][0][0],
+            &fCombinationTime[0][0][0] + 4 * LAST_EPHASE, 0);
+  std::fill(&fCombinationCalls[0][0][0],
+            &fCombinationCalls[0][0][0] + 4 * LAST_EPHASE, 0);
+  if (fLastEventEnd > 0) {
+    fEventTime[kIO] = now - fLastEventEnd;
+    fEventCalls[kIO] = 1;
+  }
+}
+
+void AliAnalysisTaskARComposite::EndEvent() {
+  // the phases before kWEIGHTS are done once for all variants
+  for (Int_t p = 0; p < kWEIGHTS; p++) {
+    fSharedTime[p] += fEventTime[p];
+    fSharedCalls[p] += fEventCalls[p];
+  }
+  fLastEventEnd = Now();
+}
+
+void AliAnalysisTaskARComposite::FillTiming() {
+  // every event passes through the shared phases once for all variants, but
+  // would have to for each of them if they were separate wagons, so they are
+  // counted for every variant
+  // the sums are reset, so calling this again only adds later events
+  for (std::size_t v = 0; v < fVariantPhaseTime.size(); v++) {
+    for (Int_t p = 0; p < LAST_EPHASE; p++) {
+      Long64_t time = p < kWEIGHTS ? fSharedTime[p] : fVariantTime[v][p];
+      Long64_t calls = p < kWEIGHTS ? fSharedCalls[p] : fVariantCalls[v][p];
+      if (calls > 0) {
+        fVariantPhaseTime[v]->Fill(p + 0.5, time);
+        fVariantPhaseCalls[v]->Fill(p + 0.5, calls);
+      }
+    }
+    fVariantTime[v].fill(0);
+    fVariantCalls[v].fill(0);
+  }
+  std::fill(fSharedTime, fSharedTime + LAST_EPHASE, 0);
+  std::fill(fSharedCalls, fSharedCalls + LAST_EPHASE, 0);
+}
+#endif
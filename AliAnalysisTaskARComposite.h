@@ -0,0 +1,261 @@
+/**
+ * File              : AliAnalysisTaskARComposite.h
+ * Author            : Anton Riedel <anton.riedel@tum.de>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+ */
+
+// Composite wagon replacing the cloned AliAnalysisTaskAR instances created in
+// AddTask.C. Event and track selection is done once per event and the
+// selected tracks are shared by all variants: Q-vectors or nested loops,
+// with or without weights, each in its own centrality bin. Every variant
+// writes its own output TList into its own output slot. The outputs hold
+// other objects than those of AliAnalysisTaskAR, so their names carry the
+// suffix _Composite.
+// Every output TList also holds the time spent in and the number of calls of
+// every phase of the analysis, as far as they are needed by this variant,
+// and the time per event vs. multiplicity. Phase times are summed in plain
+// arrays and filled into the output once, in FinishTaskOutput. Define
+// ARCOMPOSITE_NO_TIMING when compiling, e.g. with
+// gSystem->AddIncludePath("-DARCOMPOSITE_NO_TIMING") before loading the task
+// with ACLiC, to remove all of it.
+
+#ifndef ALIANALYSISTASKARCOMPOSITE_H
+#define ALIANALYSISTASKARCOMPOSITE_H
+
+#ifndef ARCOMPOSITE_NO_TIMING
+#define ARCOMPOSITE_TIMING
+#endif
+
+#include "AliAnalysisTaskSE.h"
+#include "ColumnarSkim.h"
+#include "CorrelatorEngine.h"
+
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TList.h>
+#include <TProfile.h>
+#include <TString.h>
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+class AliAODEvent;
+
+class AliAnalysisTaskARComposite : public AliAnalysisTaskSE {
+public:
+  enum Kinematic { kPHI, kPT, kETA, LAST_EKINEMATIC };
+  // phases of the analysis which are timed, kIO is the time spent outside of
+  // the task between two events, i.e. reading the event and running other
+  // tasks, plus reading the event variables and writing the skim
+  enum Phase {
+    kIO,
+    kEVENTCUTS,
+    kTRACKCUTS,
+    kWEIGHTS,
+    kQFILL,
+    kCORRELATORS,
+    kNESTEDLOOPS,
+    kHISTOGRAMS,
+    LAST_EPHASE
+  };
+  static const char *GetPhaseName(Phase phase) {
+    static const char *names[LAST_EPHASE] = {
+        "IO",          "EventCuts",   "TrackCuts",   "Weights",
+        "QFill",       "Correlators", "NestedLoops", "Histograms"};
+    return names[phase];
+  }
+
+  AliAnalysisTaskARComposite();
+  AliAnalysisTaskARComposite(const char *name);
+  virtual ~AliAnalysisTaskARComposite();
+
+  virtual void UserCreateOutputObjects();
+  virtual void UserExec(Option_t *);
+  virtual void FinishTaskOutput();
+  virtual void Terminate(Option_t *);
+
+  // process one event of a columnar skim instead of an AOD event
+  void ProcessSkimEvent(const ColumnarSkim::EventView &event);
+
+  // add a variant, returns the output slot it writes its TList into
+  Int_t AddVariant(const char *name, Double_t centralityMin,
+                   Double_t centralityMax, Bool_t useNestedLoops,
+                   Bool_t useWeights);
+  Int_t GetNumberOfVariants() const { return fVariantNames.size(); }
+  const char *GetVariantName(Int_t variant) const {
+    return fVariantNames.at(variant).Data();
+  }
+  TList *GetVariantOutput(Int_t variant) const {
+    return fVariantOutputs.at(variant);
+  }
+
+  // event and track cuts shared by all variants
+  void SetDefaultCuts(Int_t filterBit, Double_t centralityMin,
+                      Double_t centralityMax);
+  void SetCentralityEstimator(const char *estimator) {
+    fCentralityEstimator = estimator;
+  }
+  void SetCentralityRange(Double_t min, Double_t max) {
+    fCentralityRange[0] = min;
+    fCentralityRange[1] = max;
+  }
+  void SetPrimaryVertexZRange(Double_t min, Double_t max) {
+    fPrimaryVertexZRange[0] = min;
+    fPrimaryVertexZRange[1] = max;
+  }
+  void SetNContributorsMin(Int_t min) { fNContributorsMin = min; }
+  void SetFilterBit(Int_t filterBit) { fFilterBit = filterBit; }
+  void SetPtRange(Double_t min, Double_t max) {
+    fPtRange[0] = min;
+    fPtRange[1] = max;
+  }
+  void SetEtaRange(Double_t min, Double_t max) {
+    fEtaRange[0] = min;
+    fEtaRange[1] = max;
+  }
+  void SetTPCClustersRange(Int_t min, Int_t max) {
+    fTPCClustersRange[0] = min;
+    fTPCClustersRange[1] = max;
+  }
+  void SetChi2PerNDFRange(Double_t min, Double_t max) {
+    fChi2PerNDFRange[0] = min;
+    fChi2PerNDFRange[1] = max;
+  }
+  void SetDCAxyMax(Double_t max) { fDCAxyMax = max; }
+  void SetDCAzMax(Double_t max) { fDCAzMax = max; }
+
+  // analysis shared by all variants
+  void SetCorrelators(const std::vector<std::vector<Int_t>> &correlators) {
+    fCorrelators = correlators;
+  }
+  void SetFixedMultiplicity(Int_t multiplicity) {
+    fFixedMultiplicity = multiplicity;
+  }
+  // number of threads used for nested loops, <= 0 uses all cores
+  void SetNestedLoopsThreads(Int_t nThreads) { fNestedLoopsThreads = nThreads; }
+  void SetWeightHistogram(Kinematic kinematic, TH1D *histogram) {
+    fWeightHistograms[kinematic] = histogram;
+  }
+
+  // write all events in the centrality range with all tracks passing the
+  // filter bit into a columnar skim file, together with the variables of all
+  // other event and track cuts, so they can be applied again when reading it
+  void SetSkimFile(const char *path) { fSkimFile = path; }
+
+private:
+  AliAnalysisTaskARComposite(const AliAnalysisTaskARComposite &);
+  AliAnalysisTaskARComposite &operator=(const AliAnalysisTaskARComposite &);
+
+  Bool_t SurviveEventCut(Double_t centrality, Double_t vertexZ,
+                         Int_t nContributors);
+  Bool_t SurviveTrackCut(UInt_t filterMap, Double_t pt, Double_t eta,
+                         Int_t tpcClusters, Double_t chi2PerNDF,
+                         Double_t dcaXY, Double_t dcaZ, Int_t charge);
+  void FillSelectedTracks(AliAODEvent *aod);
+  void WriteSkimEvent(AliAODEvent *aod, Double_t centrality,
+                      Double_t vertexZ, Int_t nContributors);
+  void ProcessSelectedTracks(Double_t centrality);
+  void CreateWeightTables();
+  void FillWeights();
+  void ComputeCorrelators(Bool_t useNestedLoops, Bool_t useWeights);
+
+  // timing, no-ops if compiled without it
+#ifdef ARCOMPOSITE_TIMING
+  static Long64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+  Long64_t StartTimer() const { return Now(); }
+  void StopTimer(Phase phase, Long64_t start) {
+    fEventTime[phase] += Now() - start;
+    fEventCalls[phase]++;
+  }
+  void StopTimer(Phase phase, Long64_t start, Bool_t useNestedLoops,
+                 Bool_t useWeights) {
+    fCombinationTime[useNestedLoops][useWeights][phase] += Now() - start;
+    fCombinationCalls[useNestedLoops][useWeights][phase]++;
+  }
+  void BeginEvent();
+  void EndEvent();
+  void FillTiming();
+#else
+  Long64_t StartTimer() const { return 0; }
+  void StopTimer(Phase, Long64_t) {}
+  void StopTimer(Phase, Long64_t, Bool_t, Bool_t) {}
+  void BeginEvent() {}
+  void EndEvent() {}
+  void FillTiming() {}
+#endif
+
+  // variants
+  std::vector<TString> fVariantNames;
+  std::vector<Double_t> fVariantCentralityMin;
+  std::vector<Double_t> fVariantCentralityMax;
+  std::vector<Bool_t> fVariantUseNestedLoops;
+  std::vector<Bool_t> fVariantUseWeights;
+  std::vector<TList *> fVariantOutputs; //!
+  // objects of the output lists, filled for every event
+  std::vector<TH1D *> fVariantCentrality;       //!
+  std::vector<TH1D *> fVariantMultiplicity;     //!
+  std::vector<TProfile *> fVariantCorrelators;  //!
+
+  // event cuts
+  TString fCentralityEstimator;
+  Double_t fCentralityRange[2];
+  Double_t fPrimaryVertexZRange[2];
+  Int_t fNContributorsMin;
+
+  // track cuts
+  Int_t fFilterBit;
+  Double_t fPtRange[2];
+  Double_t fEtaRange[2];
+  Int_t fTPCClustersRange[2];
+  Double_t fChi2PerNDFRange[2];
+  Double_t fDCAxyMax;
+  Double_t fDCAzMax;
+
+  // analysis
+  std::vector<std::vector<Int_t>> fCorrelators;
+  Int_t fFixedMultiplicity;
+  Int_t fNestedLoopsThreads;
+  TH1D *fWeightHistograms[LAST_EKINEMATIC];
+  CorrelatorEngine::WeightTable fWeightTables[LAST_EKINEMATIC]; //!
+
+  // skim
+  TString fSkimFile;
+  ColumnarSkim::Writer *fSkimWriter; //!
+
+  // per event buffers shared by all variants
+  CorrelatorEngine::Event fSelectedTracks;                  //!
+  CorrelatorEngine::CorrelatorSet fCorrelatorSet;           //!
+  CorrelatorEngine::NestedLoopsEngine *fNestedLoops;        //!
+  std::vector<CorrelatorEngine::Result> fResults[2][2];     //!
+  Bool_t fResultsValid[2][2];                               //!
+
+#ifdef ARCOMPOSITE_TIMING
+  // time in ns and calls of the phases shared by all variants in this event
+  // and of the phases of every combination of method and weights
+  Long64_t fEventTime[LAST_EPHASE];                         //!
+  Long64_t fEventCalls[LAST_EPHASE];                        //!
+  Long64_t fCombinationTime[2][2][LAST_EPHASE];             //!
+  Long64_t fCombinationCalls[2][2][LAST_EPHASE];            //!
+  Long64_t fLastEventEnd;                                   //!
+  // time in ns and calls summed over all events, of the shared phases once
+  // and of the other phases per variant, filled in FillTiming
+  Long64_t fSharedTime[LAST_EPHASE];                        //!
+  Long64_t fSharedCalls[LAST_EPHASE];                       //!
+  std::vector<std::array<Long64_t, LAST_EPHASE>> fVariantTime;  //!
+  std::vector<std::array<Long64_t, LAST_EPHASE>> fVariantCalls; //!
+  std::vector<TH1D *> fVariantPhaseTime;                    //!
+  std::vector<TH1D *> fVariantPhaseCalls;                   //!
+  std::vector<TH2D *> fVariantTimeVsMultiplicity;           //!
+#endif
+
+  ClassDef(AliAnalysisTaskARComposite, 4);
+};
+
+#endif // ALIANALYSISTASKARCOMPOSITE_H
@@ -0,0 +1,403 @@
+/**
+ * File              : ColumnarSkim.h
+ * Author            : Anton Riedel <anton.riedel@tum.de>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+ */
+
+// Columnar skim format holding only what the composite wagon needs: event
+// cut variables per event and kinematics plus track cut variables per track.
+// A skim file is a file header followed by blocks. Every block holds one
+// flat array per event column, the offsets of the tracks of every event
+// (nEvents + 1 entries) and one flat array per track column. All arrays
+// start at 8 byte boundaries, so the reader maps the file into memory and
+// hands out pointers into it directly, without decoding or copying.
+
+#ifndef COLUMNARSKIM_H
+#define COLUMNARSKIM_H
+
+#include <Rtypes.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ColumnarSkim {
+
+enum EventColumn { kCENTRALITY, kVERTEXZ, kNCONTRIBUTORS, LAST_EEVENTCOLUMN };
+enum TrackColumn {
+  kFILTERMAP,
+  kPHI,
+  kPT,
+  kETA,
+  kCHARGE,
+  kTPCCLUSTERS,
+  kCHI2PERNDF,
+  kDCAXY,
+  kDCAZ,
+  LAST_ETRACKCOLUMN
+};
+
+// size in bytes of one entry of every column
+// kinematics are stored in double precision, so the analysis sees exactly
+// the same values as when running over the AOD
+const UInt_t kEventColumnSize[LAST_EEVENTCOLUMN] = {4, 4, 4};
+const UInt_t kTrackColumnSize[LAST_ETRACKCOLUMN] = {4, 8, 8, 8, 4,
+                                                    4, 4, 4, 4};
+
+const char kMagic[8] = {'A', 'R', 'S', 'K', 'I', 'M', '0', '1'};
+
+struct FileHeader {
+  char Magic[8];
+  UInt_t NEventColumns;
+  UInt_t NTrackColumns;
+};
+
+struct BlockHeader {
+  ULong64_t NEvents;
+  ULong64_t NTracks;
+};
+
+inline ULong64_t Align(ULong64_t size) { return (size + 7) & ~7ULL; }
+
+// size of a block with nEvents events and nTracks tracks, including header
+inline ULong64_t BlockSize(ULong64_t nEvents, ULong64_t nTracks) {
+  ULong64_t size = sizeof(BlockHeader);
+  for (Int_t c = 0; c < LAST_EEVENTCOLUMN; c++) {
+    size += Align(nEvents * kEventColumnSize[c]);
+  }
+  size += (nEvents + 1) * sizeof(ULong64_t);
+  for (Int_t c = 0; c < LAST_ETRACKCOLUMN; c++) {
+    size += Align(nTracks * kTrackColumnSize[c]);
+  }
+  return size;
+}
+
+// Writes a skim file block by block, so memory stays bounded by the block
+// size no matter how many events are written. A failed write, e.g. on a full
+// disk, is remembered, so IsGood() and Close() report it.
+class Writer {
+public:
+  ~Writer() { Close(); }
+
+  Bool_t Open(const char *path, ULong64_t tracksPerBlock = 1000000) {
+    fFile = std::fopen(path, "wb");
+    if (!fFile) {
+      return kFALSE;
+    }
+    fTracksPerBlock = tracksPerBlock;
+    FileHeader header;
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.NEventColumns = LAST_EEVENTCOLUMN;
+    header.NTrackColumns = LAST_ETRACKCOLUMN;
+    fGood = std::fwrite(&header, sizeof(header), 1, fFile) == 1;
+    Reset();
+    return fGood;
+  }
+  Bool_t IsOpen() const { return fFile != nullptr; }
+  // kFALSE once any write failed
+  Bool_t IsGood() const { return fGood; }
+
+  void AddEvent(Float_t centrality, Float_t vertexZ, Int_t nContributors) {
+    if (fOffsets.size() > 1 && fOffsets.back() >= fTracksPerBlock) {
+      WriteBlock();
+    }
+    Append(fEventColumns[kCENTRALITY], centrality);
+    Append(fEventColumns[kVERTEXZ], vertexZ);
+    Append(fEventColumns[kNCONTRIBUTORS], nContributors);
+    fOffsets.push_back(fOffsets.back());
+  }
+
+  // add a track to the last event
+  void AddTrack(UInt_t filterMap, Double_t phi, Double_t pt, Double_t eta,
+                Int_t charge, Int_t tpcClusters, Float_t chi2PerNDF,
+                Float_t dcaXY, Float_t dcaZ) {
+    Append(fTrackColumns[kFILTERMAP], filterMap);
+    Append(fTrackColumns[kPHI], phi);
+    Append(fTrackColumns[kPT], pt);
+    Append(fTrackColumns[kETA], eta);
+    Append(fTrackColumns[kCHARGE], charge);
+    Append(fTrackColumns[kTPCCLUSTERS], tpcClusters);
+    Append(fTrackColumns[kCHI2PERNDF], chi2PerNDF);
+    Append(fTrackColumns[kDCAXY], dcaXY);
+    Append(fTrackColumns[kDCAZ], dcaZ);
+    fOffsets.back()++;
+  }
+
+  // write the last block and close the file, kFALSE if any write failed
+  Bool_t Close() {
+    if (!fFile) {
+      return fGood;
+    }
+    if (fOffsets.size() > 1) {
+      WriteBlock();
+    }
+    if (std::fclose(fFile) != 0) {
+      fGood = kFALSE;
+    }
+    fFile = nullptr;
+    return fGood;
+  }
+
+private:
+  template <typename T> static void Append(std::vector<char> &column, T v) {
+    const char *bytes = reinterpret_cast<const char *>(&v);
+    column.insert(column.end(), bytes, bytes + sizeof(T));
+  }
+
+  void WriteColumn(const std::vector<char> &column) {
+    static const char padding[8] = {0};
+    Write(column.data(), column.size());
+    Write(padding, Align(column.size()) - column.size());
+  }
+
+  void Write(const void *data, std::size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, fFile) != size) {
+      fGood = kFALSE;
+    }
+  }
+
+  void WriteBlock() {
+    BlockHeader header;
+    header.NEvents = fOffsets.size() - 1;
+    header.NTracks = fOffsets.back();
+    Write(&header, sizeof(header));
+    for (Int_t c = 0; c < LAST_EEVENTCOLUMN; c++) {
+      WriteColumn(fEventColumns[c]);
+    }
+    Write(fOffsets.data(), sizeof(ULong64_t) * fOffsets.size());
+    for (Int_t c = 0; c < LAST_ETRACKCOLUMN; c++) {
+      WriteColumn(fTrackColumns[c]);
+    }
+    Reset();
+  }
+
+  void Reset() {
+    for (Int_t c = 0; c < LAST_EEVENTCOLUMN; c++) {
+      fEventColumns[c].clear();
+    }
+    for (Int_t c = 0; c < LAST_ETRACKCOLUMN; c++) {
+      fTrackColumns[c].clear();
+    }
+    fOffsets.assign(1, 0);
+  }
+
+  std::FILE *fFile = nullptr;
+  Bool_t fGood = kTRUE;
+  ULong64_t fTracksPerBlock = 0;
+  std::vector<char> fEventColumns[LAST_EEVENTCOLUMN];
+  std::vector<char> fTrackColumns[LAST_ETRACKCOLUMN];
+  std::vector<ULong64_t> fOffsets;
+};
+
+// one event of a mapped skim file
+// track columns point to the first track of the event
+struct EventView {
+  Float_t Centrality;
+  Float_t VertexZ;
+  Int_t NContributors;
+  Int_t NTracks;
+  const UInt_t *FilterMap;
+  const Double_t *Phi;
+  const Double_t *Pt;
+  const Double_t *Eta;
+  const Int_t *Charge;
+  const Int_t *TPCClusters;
+  const Float_t *Chi2PerNDF;
+  const Float_t *DCAxy;
+  const Float_t *DCAz;
+};
+
+// Reads a skim file through a read-only memory mapping. Events are accessed
+// by their global index, the track columns of an event are returned as
+// pointers into the mapped file.
+class Reader {
+public:
+  ~Reader() { Close(); }
+
+  Bool_t Open(const char *path) {
+    Close();
+    Int_t fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      return kFALSE;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        static_cast<ULong64_t>(info.st_size) < sizeof(FileHeader)) {
+      close(fd);
+      return kFALSE;
+    }
+    fSize = info.st_size;
+    void *data = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return kFALSE;
+    }
+    fData = static_cast<const char *>(data);
+    madvise(data, fSize, MADV_SEQUENTIAL);
+
+    // check header and index all blocks
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(fData);
+    if (std::memcmp(header->Magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->NEventColumns != LAST_EEVENTCOLUMN ||
+        header->NTrackColumns != LAST_ETRACKCOLUMN) {
+      Close();
+      return kFALSE;
+    }
+    ULong64_t position = sizeof(FileHeader);
+    fFirstEvent.assign(1, 0);
+    while (position + sizeof(BlockHeader) <= fSize) {
+      const BlockHeader *block =
+          reinterpret_cast<const BlockHeader *>(fData + position);
+      ULong64_t size = BlockSize(block->NEvents, block->NTracks);
+      if (position + size > fSize) {
+        break;
+      }
+      fBlocks.push_back(position);
+      fFirstEvent.push_back(fFirstEvent.back() + block->NEvents);
+      position += size;
+    }
+    // a partial block is left by a job that did not finish writing
+    if (position != fSize) {
+      std::fprintf(stderr, "ColumnarSkim: %s is truncated\n", path);
+      Close();
+      return kFALSE;
+    }
+    return kTRUE;
+  }
+
+  void Close() {
+    if (fData) {
+      munmap(const_cast<char *>(fData), fSize);
+    }
+    fData = nullptr;
+    fSize = 0;
+    fBlocks.clear();
+    fFirstEvent.assign(1, 0);
+    fCurrentBlock = -1;
+  }
+
+  Long64_t GetNumberOfEvents() const { return fFirstEvent.back(); }
+
+  Bool_t GetEvent(Long64_t event, EventView &view) {
+    if (event < 0 || event >= GetNumberOfEvents()) {
+      return kFALSE;
+    }
+    // events are usually read in order, so check the current block first
+    if (fCurrentBlock < 0 || event < fFirstEvent[fCurrentBlock] ||
+        event >= fFirstEvent[fCurrentBlock + 1]) {
+      fCurrentBlock = 0;
+      while (event >= fFirstEvent[fCurrentBlock + 1]) {
+        fCurrentBlock++;
+      }
+      MapBlock(fCurrentBlock);
+    }
+    ULong64_t i = event - fFirstEvent[fCurrentBlock];
+    ULong64_t first = fOffsets[i];
+    view.Centrality = Column<Float_t>(fEventColumns[kCENTRALITY])[i];
+    view.VertexZ = Column<Float_t>(fEventColumns[kVERTEXZ])[i];
+    view.NContributors = Column<Int_t>(fEventColumns[kNCONTRIBUTORS])[i];
+    view.NTracks = fOffsets[i + 1] - first;
+    view.FilterMap = Column<UInt_t>(fTrackColumns[kFILTERMAP]) + first;
+    view.Phi = Column<Double_t>(fTrackColumns[kPHI]) + first;
+    view.Pt = Column<Double_t>(fTrackColumns[kPT]) + first;
+    view.Eta = Column<Double_t>(fTrackColumns[kETA]) + first;
+    view.Charge = Column<Int_t>(fTrackColumns[kCHARGE]) + first;
+    view.TPCClusters = Column<Int_t>(fTrackColumns[kTPCCLUSTERS]) + first;
+    view.Chi2PerNDF = Column<Float_t>(fTrackColumns[kCHI2PERNDF]) + first;
+    view.DCAxy = Column<Float_t>(fTrackColumns[kDCAXY]) + first;
+    view.DCAz = Column<Float_t>(fTrackColumns[kDCAZ]) + first;
+    return kTRUE;
+  }
+
+private:
+  template <typename T> static const T *Column(const char *column) {
+    return reinterpret_cast<const T *>(column);
+  }
+
+  void MapBlock(Int_t b) {
+    const char *position = fData + fBlocks[b];
+    const BlockHeader *block = reinterpret_cast<const BlockHeader *>(position);
+    position += sizeof(BlockHeader);
+    for (Int_t c = 0; c < LAST_EEVENTCOLUMN; c++) {
+      fEventColumns[c] = position;
+      position += Align(block->NEvents * kEventColumnSize[c]);
+    }
+    fOffsets = reinterpret_cast<const ULong64_t *>(position);
+    position += (block->NEvents + 1) * sizeof(ULong64_t);
+    for (Int_t c = 0; c < LAST_ETRACKCOLUMN; c++) {
+      fTrackColumns[c] = position;
+      position += Align(block->NTracks * kTrackColumnSize[c]);
+    }
+  }
+
+  const char *fData = nullptr;
+  ULong64_t fSize = 0;
+  std::vector<ULong64_t> fBlocks;
+  std::vector<Long64_t> fFirstEvent = {0};
+  Int_t fCurrentBlock = -1;
+  const char *fEventColumns[LAST_EEVENTCOLUMN] = {nullptr};
+  const ULong64_t *fOffsets = nullptr;
+  const char *fTrackColumns[LAST_ETRACKCOLUMN] = {nullptr};
+};
+
+// concatenate skim files, e.g. written by the workers of a parallel local
+// run, by copying all blocks behind a single file header
+// returns kFALSE if any input cannot be read or any write fails
+inline Bool_t Concatenate(const char *output,
+                          const std::vector<std::string> &inputs) {
+  std::FILE *out = std::fopen(output, "wb");
+  if (!out) {
+    return kFALSE;
+  }
+  FileHeader header;
+  std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+  header.NEventColumns = LAST_EEVENTCOLUMN;
+  header.NTrackColumns = LAST_ETRACKCOLUMN;
+  if (std::fwrite(&header, sizeof(header), 1, out) != 1) {
+    std::fclose(out);
+    return kFALSE;
+  }
+
+  std::vector<char> buffer(1 << 20);
+  for (const auto &input : inputs) {
+    std::FILE *in = std::fopen(input.c_str(), "rb");
+    if (!in) {
+      std::fclose(out);
+      return kFALSE;
+    }
+    FileHeader inputHeader;
+    if (std::fread(&inputHeader, sizeof(inputHeader), 1, in) != 1 ||
+        std::memcmp(inputHeader.Magic, kMagic, sizeof(kMagic)) != 0) {
+      std::fclose(in);
+      std::fclose(out);
+      return kFALSE;
+    }
+    std::size_t n;
+    while ((n = std::fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+      if (std::fwrite(buffer.data(), 1, n, out) != n) {
+        std::fclose(in);
+        std::fclose(out);
+        return kFALSE;
+      }
+    }
+    Bool_t readFailed = std::ferror(in) != 0;
+    std::fclose(in);
+    if (readFailed) {
+      std::fclose(out);
+      return kFALSE;
+    }
+  }
+  return std::fclose(out) == 0;
+}
+
+} // namespace ColumnarSkim
+
+#endif // COLUMNARSKIM_H
@@ -0,0 +1,860 @@
+/**
+ * File              : CorrelatorEngine.h
+ * Author            : Anton Riedel <anton.riedel@tum.de>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+ */
+
+// Standalone engine for multi-particle correlators as configured with
+// SetCorrelators. The correlators are computed from plain arrays of
+// (phi, pt, eta, weight), either with Q-vectors and the generic recursive
+// formula or with nested loops, i.e. the same two methods used by the wagons
+// created in AddTask.C. No AliROOT/AliPhysics is needed, only ROOT types.
+
+#ifndef CORRELATORENGINE_H
+#define CORRELATORENGINE_H
+
+#include <Rtypes.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CorrelatorEngine {
+
+typedef std::complex<Double_t> Complex_t;
+
+// tracks of one event, one array per quantity
+struct Event {
+  std::vector<Double_t> Phi;
+  std::vector<Double_t> Pt;
+  std::vector<Double_t> Eta;
+  std::vector<Double_t> Weight;
+
+  Int_t GetMultiplicity() const { return static_cast<Int_t>(Phi.size()); }
+  void Clear() {
+    Phi.clear();
+    Pt.clear();
+    Eta.clear();
+    Weight.clear();
+  }
+  void Reserve(Int_t n) {
+    Phi.reserve(n);
+    Pt.reserve(n);
+    Eta.reserve(n);
+    Weight.reserve(n);
+  }
+  void AddTrack(Double_t phi, Double_t pt, Double_t eta,
+                Double_t weight = 1.) {
+    Phi.push_back(phi);
+    Pt.push_back(pt);
+    Eta.push_back(eta);
+    Weight.push_back(weight);
+  }
+};
+
+// correlator of one event
+// Value is the event average <cos(n_1*phi_1+...+n_k*phi_k)> and Weight the
+// event weight it enters the profile with, i.e. the sum over all products of
+// particle weights of distinct k-tuples
+struct Result {
+  Double_t Value = 0.;
+  Double_t Weight = 0.;
+};
+
+// Q-vectors Q_{n,p} = sum_i w_i^p exp(i*n*phi_i) of one event
+// only non-negative harmonics are stored, Q_{-n,p} = conj(Q_{n,p})
+class QVector {
+public:
+  void Fill(const Event &event, Int_t maxHarmonic, Int_t maxPower,
+            Bool_t useWeights) {
+    fMaxHarmonic = maxHarmonic;
+    fMaxPower = maxPower;
+    fQ.assign((maxHarmonic + 1) * (maxPower + 1), Complex_t(0., 0.));
+
+    for (Int_t i = 0; i < event.GetMultiplicity(); i++) {
+      const Complex_t phase = std::polar(1., event.Phi[i]);
+      const Double_t w = useWeights ? event.Weight[i] : 1.;
+      Complex_t harmonic(1., 0.);
+      for (Int_t n = 0; n <= maxHarmonic; n++) {
+        Double_t weightPower = 1.;
+        for (Int_t p = 0; p <= maxPower; p++) {
+          fQ[n * (maxPower + 1) + p] += weightPower * harmonic;
+          weightPower *= w;
+        }
+        harmonic *= phase;
+      }
+    }
+  }
+
+  Complex_t Q(Int_t n, Int_t p) const {
+    if (n >= 0) {
+      return fQ[n * (fMaxPower + 1) + p];
+    }
+    return std::conj(fQ[-n * (fMaxPower + 1) + p]);
+  }
+
+  // generic recursive formula for the k-particle correlator with harmonics
+  // harmonic[0..k-1], originally developed by Kristjan Gulbrandsen
+  // the harmonics are permuted during the recursion and restored afterwards
+  Complex_t Recursion(Int_t k, Int_t *harmonic, Int_t mult = 1,
+                      Int_t skip = 0) const {
+    Int_t km1 = k - 1;
+    Complex_t c = Q(harmonic[km1], mult);
+    if (km1 == 0) {
+      return c;
+    }
+    c *= Recursion(km1, harmonic);
+    if (km1 == skip) {
+      return c;
+    }
+
+    Int_t multp1 = mult + 1;
+    Int_t km2 = k - 2;
+    Int_t counter1 = 0;
+    Int_t hhold = harmonic[counter1];
+    harmonic[counter1] = harmonic[km2];
+    harmonic[km2] = hhold + harmonic[km1];
+    Complex_t c2 = Recursion(km1, harmonic, multp1, km2);
+    Int_t counter2 = k - 3;
+    while (counter2 >= skip) {
+      harmonic[km2] = harmonic[counter1];
+      harmonic[counter1] = hhold;
+      ++counter1;
+      hhold = harmonic[counter1];
+      harmonic[counter1] = harmonic[km2];
+      harmonic[km2] = hhold + harmonic[km1];
+      c2 += Recursion(km1, harmonic, multp1, counter2);
+      --counter2;
+    }
+    harmonic[km2] = harmonic[counter1];
+    harmonic[counter1] = hhold;
+
+    if (mult == 1) {
+      return c - c2;
+    }
+    return c - static_cast<Double_t>(mult) * c2;
+  }
+
+private:
+  Int_t fMaxHarmonic = 0;
+  Int_t fMaxPower = 0;
+  std::vector<Complex_t> fQ;
+};
+
+// Lookup table for the particle weights of one kinematic variable, built
+// from the bin contents of a weight histogram including under- and overflow.
+// The bin is found with the same arithmetic as TAxis::FindBin, so the result
+// is identical to GetBinContent(FindBin(x)), but without any virtual calls.
+// Weights are computed in batches: first the bins of a batch of tracks in a
+// loop the compiler can vectorize, then a gather from the table.
+class WeightTable {
+public:
+  // equidistant bins, contents[0] is the underflow and contents[nbins + 1]
+  // the overflow bin
+  void SetFixedBins(Int_t nbins, Double_t min, Double_t max,
+                    const Double_t *contents) {
+    fNbins = nbins;
+    fMin = min;
+    fMax = max;
+    fEdges.clear();
+    fContents.assign(contents, contents + nbins + 2);
+  }
+  // variable bins, edges has nbins + 1 entries
+  void SetVariableBins(const std::vector<Double_t> &edges,
+                       const Double_t *contents) {
+    fNbins = static_cast<Int_t>(edges.size()) - 1;
+    fMin = edges.front();
+    fMax = edges.back();
+    fEdges = edges;
+    fContents.assign(contents, contents + fNbins + 2);
+  }
+  Bool_t IsEmpty() const { return fContents.empty(); }
+
+  // multiply weights[i] with the weight of x[i] for all 0 <= i < n
+  void Multiply(const Double_t *x, Int_t n, Double_t *weights) const {
+    Int_t bins[kBatchSize];
+    for (Int_t first = 0; first < n; first += kBatchSize) {
+      // no std::min, it would bind kBatchSize to a reference
+      const Int_t size = n - first < kBatchSize ? n - first : kBatchSize;
+      const Double_t *xBatch = x + first;
+      if (fEdges.empty()) {
+        const Double_t nbins = fNbins;
+        for (Int_t i = 0; i < size; i++) {
+          Double_t t = nbins * (xBatch[i] - fMin) / (fMax - fMin);
+          t = xBatch[i] < fMin ? -1. : t;
+          t = !(xBatch[i] < fMax) ? nbins : t;
+          bins[i] = 1 + static_cast<Int_t>(t);
+        }
+      } else {
+        for (Int_t i = 0; i < size; i++) {
+          if (xBatch[i] < fMin) {
+            bins[i] = 0;
+          } else if (!(xBatch[i] < fMax)) {
+            bins[i] = fNbins + 1;
+          } else {
+            bins[i] = std::upper_bound(fEdges.begin(), fEdges.end(),
+                                       xBatch[i]) -
+                      fEdges.begin();
+          }
+        }
+      }
+      Double_t *weightsBatch = weights + first;
+      for (Int_t i = 0; i < size; i++) {
+        weightsBatch[i] *= fContents[bins[i]];
+      }
+    }
+  }
+
+private:
+  static constexpr Int_t kBatchSize = 256;
+  Int_t fNbins = 0;
+  Double_t fMin = 0.;
+  Double_t fMax = 0.;
+  std::vector<Double_t> fEdges;
+  std::vector<Double_t> fContents;
+};
+
+// largest harmonic appearing in the recursion, i.e. the sum of all |n_i|
+inline Int_t MaxHarmonic(const std::vector<Int_t> &harmonics) {
+  Int_t max = 0;
+  for (auto n : harmonics) {
+    max += std::abs(n);
+  }
+  return max;
+}
+
+// compute correlator with Q-vectors from an already filled QVector
+inline Result QVectors(const QVector &q, const std::vector<Int_t> &harmonics) {
+  Result result;
+  std::vector<Int_t> h(harmonics);
+  std::vector<Int_t> zero(harmonics.size(), 0);
+  const Int_t k = static_cast<Int_t>(harmonics.size());
+  result.Weight = q.Recursion(k, zero.data()).real();
+  if (result.Weight > 0.) {
+    result.Value = q.Recursion(k, h.data()).real() / result.Weight;
+  }
+  return result;
+}
+
+// compute correlator with Q-vectors
+inline Result QVectors(const Event &event, const std::vector<Int_t> &harmonics,
+                       Bool_t useWeights) {
+  QVector q;
+  q.Fill(event, MaxHarmonic(harmonics), static_cast<Int_t>(harmonics.size()),
+         useWeights);
+  return QVectors(q, harmonics);
+}
+
+// A set of correlators evaluated together with a shared Q-vector table.
+// When the correlators are set, the generic recursive formula is unrolled
+// once for all of them into a list of sub-terms, memoized across all
+// correlators and their denominators. Every sub-term is
+// value = Q_{n,p} * value[product] - factor * sum value[subtract],
+// with its children always earlier in the list. Per event, only the Q_{n,p}
+// needed by any sub-term are filled in a single pass over the tracks and all
+// sub-terms are evaluated once in order, so the cost grows with the number of
+// distinct sub-terms and not with the number of correlators times their
+// order.
+class CorrelatorSet {
+public:
+  void SetCorrelators(const std::vector<std::vector<Int_t>> &correlators) {
+    fNodes.clear();
+    fQKeys.clear();
+    fNumerators.clear();
+    fDenominators.clear();
+    std::map<std::vector<Int_t>, Int_t> memo;
+    std::map<std::pair<Int_t, Int_t>, Int_t> qIndex;
+    for (const auto &correlator : correlators) {
+      std::vector<Int_t> h(correlator);
+      std::vector<Int_t> zero(correlator.size(), 0);
+      const Int_t k = static_cast<Int_t>(correlator.size());
+      fNumerators.push_back(k > 0 ? Build(k, h.data(), 1, 0, memo, qIndex)
+                                  : -1);
+      fDenominators.push_back(k > 0 ? Build(k, zero.data(), 1, 0, memo, qIndex)
+                                    : -1);
+    }
+    fMaxHarmonic = 0;
+    fMaxPower = 0;
+    for (const auto &key : fQKeys) {
+      fMaxHarmonic = std::max(fMaxHarmonic, key.first);
+      fMaxPower = std::max(fMaxPower, key.second);
+    }
+    fQ.assign(fQKeys.size(), Complex_t(0., 0.));
+    fValues.assign(fNodes.size(), Complex_t(0., 0.));
+    // buffers of FillQVectors, sized once so no memory is allocated per event
+    fRe.assign(fQKeys.size(), 0.);
+    fIm.assign(fQKeys.size(), 0.);
+    fHarmonic.assign(fMaxHarmonic + 1, Complex_t(0., 0.));
+    fWeightPower.assign(fMaxPower + 1, 0.);
+  }
+
+  Int_t GetNumberOfCorrelators() const { return fNumerators.size(); }
+  Int_t GetNumberOfSubTerms() const { return fNodes.size(); }
+  Int_t GetNumberOfQVectors() const { return fQKeys.size(); }
+
+  // fill all needed Q_{n,p} in one pass over the tracks and evaluate all
+  // sub-terms
+  void Fill(const Event &event, Bool_t useWeights) {
+    FillQVectors(event, useWeights);
+    Evaluate();
+  }
+
+  // the two steps of Fill, e.g. to time them separately
+  void FillQVectors(const Event &event, Bool_t useWeights) {
+    const Int_t nKeys = fQKeys.size();
+    std::fill(fRe.begin(), fRe.end(), 0.);
+    std::fill(fIm.begin(), fIm.end(), 0.);
+    Double_t *re = fRe.data();
+    Double_t *im = fIm.data();
+    Complex_t *harmonic = fHarmonic.data();
+    Double_t *weightPower = fWeightPower.data();
+
+    for (Int_t i = 0; i < event.GetMultiplicity(); i++) {
+      const Complex_t phase = std::polar(1., event.Phi[i]);
+      const Double_t w = useWeights ? event.Weight[i] : 1.;
+      harmonic[0] = Complex_t(1., 0.);
+      for (Int_t n = 1; n <= fMaxHarmonic; n++) {
+        harmonic[n] = harmonic[n - 1] * phase;
+      }
+      weightPower[0] = 1.;
+      for (Int_t p = 1; p <= fMaxPower; p++) {
+        weightPower[p] = weightPower[p - 1] * w;
+      }
+      for (Int_t q = 0; q < nKeys; q++) {
+        const Double_t wp = weightPower[fQKeys[q].second];
+        re[q] += wp * harmonic[fQKeys[q].first].real();
+        im[q] += wp * harmonic[fQKeys[q].first].imag();
+      }
+    }
+    for (Int_t q = 0; q < nKeys; q++) {
+      fQ[q] = Complex_t(re[q], im[q]);
+    }
+  }
+
+  void Evaluate() {
+    for (std::size_t i = 0; i < fNodes.size(); i++) {
+      const Node &node = fNodes[i];
+      Complex_t c = node.Conjugate ? std::conj(fQ[node.Q]) : fQ[node.Q];
+      if (node.Product >= 0) {
+        c *= fValues[node.Product];
+      }
+      if (!node.Subtract.empty()) {
+        Complex_t c2(0., 0.);
+        for (auto s : node.Subtract) {
+          c2 += fValues[s];
+        }
+        c -= node.Factor * c2;
+      }
+      fValues[i] = c;
+    }
+  }
+
+  // correlator c of the event passed to the last call of Fill
+  Result GetResult(Int_t c) const {
+    Result result;
+    if (fNumerators[c] < 0) {
+      return result;
+    }
+    result.Weight = fValues[fDenominators[c]].real();
+    if (result.Weight > 0.) {
+      result.Value = fValues[fNumerators[c]].real() / result.Weight;
+    }
+    return result;
+  }
+
+private:
+  struct Node {
+    Int_t Q = -1;
+    Bool_t Conjugate = kFALSE;
+    Int_t Product = -1;
+    Double_t Factor = 1.;
+    std::vector<Int_t> Subtract;
+  };
+
+  // same control flow as QVector::Recursion, but instead of computing values
+  // every distinct call is recorded once as a sub-term
+  Int_t Build(Int_t k, Int_t *harmonic, Int_t mult, Int_t skip,
+              std::map<std::vector<Int_t>, Int_t> &memo,
+              std::map<std::pair<Int_t, Int_t>, Int_t> &qIndex) {
+    std::vector<Int_t> key = {k, mult, skip};
+    key.insert(key.end(), harmonic, harmonic + k);
+    auto found = memo.find(key);
+    if (found != memo.end()) {
+      return found->second;
+    }
+
+    Node node;
+    Int_t km1 = k - 1;
+    std::pair<Int_t, Int_t> q(std::abs(harmonic[km1]), mult);
+    if (qIndex.find(q) == qIndex.end()) {
+      qIndex[q] = fQKeys.size();
+      fQKeys.push_back(q);
+    }
+    node.Q = qIndex[q];
+    node.Conjugate = harmonic[km1] < 0;
+
+    if (km1 > 0) {
+      node.Product = Build(km1, harmonic, 1, 0, memo, qIndex);
+      if (km1 != skip) {
+        Int_t multp1 = mult + 1;
+        Int_t km2 = k - 2;
+        Int_t counter1 = 0;
+        Int_t hhold = harmonic[counter1];
+        harmonic[counter1] = harmonic[km2];
+        harmonic[km2] = hhold + harmonic[km1];
+        node.Subtract.push_back(
+            Build(km1, harmonic, multp1, km2, memo, qIndex));
+        Int_t counter2 = k - 3;
+        while (counter2 >= skip) {
+          harmonic[km2] = harmonic[counter1];
+          harmonic[counter1] = hhold;
+          ++counter1;
+          hhold = harmonic[counter1];
+          harmonic[counter1] = harmonic[km2];
+          harmonic[km2] = hhold + harmonic[km1];
+          node.Subtract.push_back(
+              Build(km1, harmonic, multp1, counter2, memo, qIndex));
+          --counter2;
+        }
+        harmonic[km2] = harmonic[counter1];
+        harmonic[counter1] = hhold;
+        node.Factor = mult;
+      }
+    }
+
+    fNodes.push_back(node);
+    memo[key] = fNodes.size() - 1;
+    return fNodes.size() - 1;
+  }
+
+  std::vector<Node> fNodes;
+  std::vector<std::pair<Int_t, Int_t>> fQKeys;
+  std::vector<Int_t> fNumerators;
+  std::vector<Int_t> fDenominators;
+  Int_t fMaxHarmonic = 0;
+  Int_t fMaxPower = 0;
+  std::vector<Complex_t> fQ;
+  std::vector<Complex_t> fValues;
+  std::vector<Double_t> fRe;
+  std::vector<Double_t> fIm;
+  std::vector<Complex_t> fHarmonic;
+  std::vector<Double_t> fWeightPower;
+};
+
+// Pool of threads running task(t, thread) for all 0 <= t < nTasks, where
+// thread is the index of the thread running it, e.g. for buffers per thread.
+// Threads are created once and reused for every call of Run, so no threads
+// are started per event.
+// Every thread starts with its own contiguous range of tasks, taken from the
+// front. A thread running out of tasks steals the back half of the range of
+// another thread, so the load stays balanced even if tasks differ in cost.
+// The thread calling Run works as one of the threads. nThreads <= 0 uses all
+// available cores.
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(Int_t nThreads = 0) {
+    if (nThreads <= 0) {
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    fNThreads = nThreads;
+    fRanges.reset(new Range[fNThreads]);
+    for (Int_t i = 1; i < fNThreads; i++) {
+      fThreads.emplace_back(&WorkStealingPool::Loop, this, i);
+    }
+  }
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = kTRUE;
+    }
+    fStart.notify_all();
+    for (auto &thread : fThreads) {
+      thread.join();
+    }
+  }
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  Int_t GetNumberOfThreads() const { return fNThreads; }
+
+  void Run(Int_t nTasks, const std::function<void(Int_t, Int_t)> &task) {
+    if (fNThreads <= 1 || nTasks <= 1) {
+      for (Int_t t = 0; t < nTasks; t++) {
+        task(t, 0);
+      }
+      return;
+    }
+    for (Int_t i = 0; i < fNThreads; i++) {
+      fRanges[i].Begin = static_cast<Long64_t>(nTasks) * i / fNThreads;
+      fRanges[i].End = static_cast<Long64_t>(nTasks) * (i + 1) / fNThreads;
+    }
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fTask = &task;
+      fRunning = fNThreads - 1;
+      fGeneration++;
+    }
+    fStart.notify_all();
+    Work(0);
+    std::unique_lock<std::mutex> lock(fMutex);
+    fDone.wait(lock, [this] { return fRunning == 0; });
+    fTask = nullptr;
+  }
+
+private:
+  struct Range {
+    std::mutex Mutex;
+    Int_t Begin = 0;
+    Int_t End = 0;
+  };
+
+  // wait for the next call of Run
+  void Loop(Int_t id) {
+    Long64_t generation = 0;
+    while (kTRUE) {
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fStart.wait(lock,
+                    [&] { return fStop || fGeneration != generation; });
+        if (fStop) {
+          return;
+        }
+        generation = fGeneration;
+      }
+      Work(id);
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (--fRunning == 0) {
+        fDone.notify_one();
+      }
+    }
+  }
+
+  void Work(Int_t id) {
+    Range &own = fRanges[id];
+    while (kTRUE) {
+      Int_t t = -1;
+      {
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if (own.Begin < own.End) {
+          t = own.Begin++;
+        }
+      }
+      if (t >= 0) {
+        (*fTask)(t, id);
+        continue;
+      }
+      // steal from the first other thread with tasks left
+      Bool_t stolen = kFALSE;
+      for (Int_t i = 1; i < fNThreads && !stolen; i++) {
+        Range &victim = fRanges[(id + i) % fNThreads];
+        Int_t begin, end;
+        {
+          std::lock_guard<std::mutex> lock(victim.Mutex);
+          if (victim.Begin >= victim.End) {
+            continue;
+          }
+          begin = victim.Begin + (victim.End - victim.Begin) / 2;
+          end = victim.End;
+          victim.End = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        own.Begin = begin;
+        own.End = end;
+        stolen = kTRUE;
+      }
+      if (!stolen) {
+        return;
+      }
+    }
+  }
+
+  Int_t fNThreads = 1;
+  std::unique_ptr<Range[]> fRanges;
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fStart;
+  std::condition_variable fDone;
+  Long64_t fGeneration = 0;
+  Int_t fRunning = 0;
+  Bool_t fStop = kFALSE;
+  const std::function<void(Int_t, Int_t)> *fTask = nullptr;
+};
+
+// Particle data for nested loops, laid out for sequential access: for every
+// depth d of the loops the real and imaginary parts of w_j*exp(i*n_d*phi_j)
+// are stored in one contiguous array each, next to the array of weights.
+// The last two loops are summed in closed form, which needs the products of
+// the last two depths per particle and the sums over all particles.
+struct NestedLoopsData {
+  static const Int_t kMaxOrder = 32;
+
+  Int_t M = 0;
+  Int_t K = 0;
+  std::vector<Double_t> Re;
+  std::vector<Double_t> Im;
+  std::vector<Double_t> W;
+  // x_j*y_j with x and y the values of particle j at depth K-2 and K-1
+  std::vector<Complex_t> Pair;
+  // sums over all particles
+  Complex_t TotalX;
+  Complex_t TotalY;
+  Complex_t TotalPair;
+  Double_t TotalW = 0.;
+  Double_t TotalW2 = 0.;
+
+  void Fill(const Event &event, const std::vector<Int_t> &harmonics,
+            Bool_t useWeights) {
+    M = event.GetMultiplicity();
+    K = static_cast<Int_t>(harmonics.size());
+    Re.resize(K * M);
+    Im.resize(K * M);
+    W.resize(M);
+    for (Int_t j = 0; j < M; j++) {
+      W[j] = useWeights ? event.Weight[j] : 1.;
+    }
+    for (Int_t d = 0; d < K; d++) {
+      for (Int_t j = 0; j < M; j++) {
+        Re[d * M + j] = W[j] * std::cos(harmonics[d] * event.Phi[j]);
+        Im[d * M + j] = W[j] * std::sin(harmonics[d] * event.Phi[j]);
+      }
+    }
+    TotalX = TotalY = TotalPair = Complex_t(0., 0.);
+    TotalW = TotalW2 = 0.;
+    Pair.resize(M);
+    for (Int_t j = 0; j < M; j++) {
+      TotalW += W[j];
+      TotalW2 += W[j] * W[j];
+      if (K < 2) {
+        continue;
+      }
+      Pair[j] = X(j) * Y(j);
+      TotalX += X(j);
+      TotalY += Y(j);
+      TotalPair += Pair[j];
+    }
+  }
+
+  Complex_t X(Int_t j) const {
+    return Complex_t(Re[(K - 2) * M + j], Im[(K - 2) * M + j]);
+  }
+  Complex_t Y(Int_t j) const {
+    return Complex_t(Re[(K - 1) * M + j], Im[(K - 1) * M + j]);
+  }
+};
+
+// sums over the particles used at lower depths, which are excluded from the
+// closed form of the last two loops
+struct NestedLoopsUsed {
+  Complex_t X;
+  Complex_t Y;
+  Complex_t Pair;
+  Double_t W = 0.;
+  Double_t W2 = 0.;
+
+  void Add(const NestedLoopsData &data, Int_t j) {
+    X += data.X(j);
+    Y += data.Y(j);
+    Pair += data.Pair[j];
+    W += data.W[j];
+    W2 += data.W[j] * data.W[j];
+  }
+};
+
+// loop over all particles not marked as used at a lower depth
+// the last two loops run over all pairs of distinct unused particles a, b,
+// so they sum to (X - X_used)(Y - Y_used) - (sum_j x_j y_j - used ones),
+// and the cost is M^(k-2)
+inline void NestedLoopsStep(const NestedLoopsData &data, UChar_t *marked,
+                            Int_t depth, Complex_t product, Double_t weight,
+                            const NestedLoopsUsed &used, Double_t &numerator,
+                            Double_t &denominator) {
+  const Int_t M = data.M;
+
+  if (depth == data.K - 2) {
+    Complex_t sum = (data.TotalX - used.X) * (data.TotalY - used.Y) -
+                    (data.TotalPair - used.Pair);
+    Double_t sumW = (data.TotalW - used.W) * (data.TotalW - used.W) -
+                    (data.TotalW2 - used.W2);
+    numerator += product.real() * sum.real() - product.imag() * sum.imag();
+    denominator += weight * sumW;
+    return;
+  }
+
+  const Double_t *re = data.Re.data() + depth * M;
+  const Double_t *im = data.Im.data() + depth * M;
+  if (depth == data.K - 3) {
+    // last explicit loop: the closed forms are summed over j first and
+    // multiplied with the product of the outer loops once, in real
+    // arithmetic, as this loop runs M^(k-2) times
+    const Double_t *xRe = data.Re.data() + (depth + 1) * M;
+    const Double_t *xIm = data.Im.data() + (depth + 1) * M;
+    const Double_t *yRe = data.Re.data() + (depth + 2) * M;
+    const Double_t *yIm = data.Im.data() + (depth + 2) * M;
+    const Complex_t a = data.TotalX - used.X;
+    const Complex_t b = data.TotalY - used.Y;
+    const Complex_t c = data.TotalPair - used.Pair;
+    const Double_t wa = data.TotalW - used.W;
+    const Double_t w2a = data.TotalW2 - used.W2;
+    Double_t sumRe = 0.;
+    Double_t sumIm = 0.;
+    Double_t sumW = 0.;
+    for (Int_t j = 0; j < M; j++) {
+      if (marked[j]) {
+        continue;
+      }
+      const Double_t aRe = a.real() - xRe[j];
+      const Double_t aIm = a.imag() - xIm[j];
+      const Double_t bRe = b.real() - yRe[j];
+      const Double_t bIm = b.imag() - yIm[j];
+      const Double_t sRe =
+          aRe * bRe - aIm * bIm - c.real() + data.Pair[j].real();
+      const Double_t sIm =
+          aRe * bIm + aIm * bRe - c.imag() + data.Pair[j].imag();
+      sumRe += re[j] * sRe - im[j] * sIm;
+      sumIm += re[j] * sIm + im[j] * sRe;
+      const Double_t w = data.W[j];
+      sumW += w * ((wa - w) * (wa - w) - (w2a - w * w));
+    }
+    numerator += product.real() * sumRe - product.imag() * sumIm;
+    denominator += weight * sumW;
+    return;
+  }
+  for (Int_t j = 0; j < M; j++) {
+    if (marked[j]) {
+      continue;
+    }
+    NestedLoopsUsed next = used;
+    next.Add(data, j);
+    marked[j] = 1;
+    NestedLoopsStep(data, marked, depth + 1,
+                    product * Complex_t(re[j], im[j]), weight * data.W[j],
+                    next, numerator, denominator);
+    marked[j] = 0;
+  }
+}
+
+// compute correlators with nested loops over all distinct k-tuples, for any
+// k. The last two loops are summed in closed form, the outermost one or two
+// of the remaining loops are split into tasks which are distributed over the
+// threads of a pool with work stealing. The partial sums of all tasks are
+// added in a fixed order, so the result does not depend on the number of
+// threads. Threads and buffers are kept between calls, so create one engine
+// and reuse it for all events.
+// The cost grows like M^(k-2), e.g. k = 6 at M = 200 takes seconds per event
+// on one core, see Benchmark.C.
+class NestedLoopsEngine {
+public:
+  explicit NestedLoopsEngine(Int_t nThreads = 1)
+      : fPool(nThreads), fMarked(fPool.GetNumberOfThreads()) {}
+
+  Int_t GetNumberOfThreads() const { return fPool.GetNumberOfThreads(); }
+
+  Result Compute(const Event &event, const std::vector<Int_t> &harmonics,
+                 Bool_t useWeights) {
+    Result result;
+    const Int_t k = static_cast<Int_t>(harmonics.size());
+    const Int_t M = event.GetMultiplicity();
+    if (k == 0 || k > NestedLoopsData::kMaxOrder || M < k) {
+      return result;
+    }
+
+    fData.Fill(event, harmonics, useWeights);
+
+    Double_t numerator = 0.;
+    Double_t denominator = 0.;
+    if (k == 1) {
+      for (Int_t j = 0; j < M; j++) {
+        numerator += fData.Re[j];
+      }
+      denominator = fData.TotalW;
+    } else {
+      // loops left after the closed form, at most two of them make tasks
+      const Int_t fixed = std::min(k - 2, 2);
+      const Int_t nTasks = fixed == 2 ? M * M : (fixed == 1 ? M : 1);
+      for (auto &marked : fMarked) {
+        marked.assign(M, 0);
+      }
+      const NestedLoopsData &data = fData;
+      // partial sums of task t, starting from zero
+      auto partial = [&data, fixed, M](Int_t t, UChar_t *marked,
+                                       Double_t &num, Double_t &den) {
+        Int_t first[2] = {fixed == 2 ? t / M : t, t % M};
+        if (fixed == 2 && first[0] == first[1]) {
+          return;
+        }
+        Complex_t product(1., 0.);
+        Double_t weight = 1.;
+        NestedLoopsUsed used;
+        for (Int_t d = 0; d < fixed; d++) {
+          const Int_t j = first[d];
+          product *= Complex_t(data.Re[d * M + j], data.Im[d * M + j]);
+          weight *= data.W[j];
+          used.Add(data, j);
+          marked[j] = 1;
+        }
+        NestedLoopsStep(data, marked, fixed, product, weight, used, num, den);
+        for (Int_t d = 0; d < fixed; d++) {
+          marked[first[d]] = 0;
+        }
+      };
+      if (fPool.GetNumberOfThreads() <= 1) {
+        // same order of additions as below, without buffers
+        for (Int_t t = 0; t < nTasks; t++) {
+          Double_t num = 0.;
+          Double_t den = 0.;
+          partial(t, fMarked[0].data(), num, den);
+          numerator += num;
+          denominator += den;
+        }
+      } else {
+        fNumerators.assign(nTasks, 0.);
+        fDenominators.assign(nTasks, 0.);
+        fPool.Run(nTasks, [&](Int_t t, Int_t thread) {
+          partial(t, fMarked[thread].data(), fNumerators[t],
+                  fDenominators[t]);
+        });
+        for (Int_t t = 0; t < nTasks; t++) {
+          numerator += fNumerators[t];
+          denominator += fDenominators[t];
+        }
+      }
+    }
+
+    result.Weight = denominator;
+    if (denominator > 0.) {
+      result.Value = numerator / denominator;
+    }
+    return result;
+  }
+
+private:
+  WorkStealingPool fPool;
+  NestedLoopsData fData;
+  // marks the particles used at lower depths, one array per thread
+  std::vector<std::vector<UChar_t>> fMarked;
+  std::vector<Double_t> fNumerators;
+  std::vector<Double_t> fDenominators;
+};
+
+// single correlator with a temporary engine, for repeated calls keep a
+// NestedLoopsEngine instead
+inline Result NestedLoops(const Event &event,
+                          const std::vector<Int_t> &harmonics,
+                          Bool_t useWeights, Int_t nThreads = 1) {
+  NestedLoopsEngine engine(nThreads);
+  return engine.Compute(event, harmonics, useWeights);
+}
+
+} // namespace CorrelatorEngine
+
+#endif // CORRELATORENGINE_H
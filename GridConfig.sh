@@ -2,7 +2,7 @@
 # File              : GridConfig.sh
 # Author            : Anton Riedel <anton.riedel@tum.de>
 # Date              : 25.08.2021
-# Last Modified Date: 23.11.2021
+# Last Modified Date: 16.10.2026
 # Last Modified By  : Anton Riedel <anton.riedel@tum.de>
 
 # example configuration for running a analysis on grid
@@ -41,8 +41,13 @@ export ANALYSIS_MACRO_FILE_NAME="flowAnalysis.C"
 
 # define directories and files on local machine
 export LOCAL_WORKING_DIR="$(realpath $(dirname ${BASH_SOURCE[0]}))"
+# temporary files and cached manifests of DataDir, listing all input files
+# with their size, modification time and number of events, defaults to the
+# system temporary directory if unset
 export LOCAL_TMP_DIR="/tmp"
 export LOCAL_OUTPUT_ROOT_FILE="Output.root"
+# histograms of AliAnalysisTaskAR wagons, the outputs of the composite wagon
+# (suffix _Composite) hold other objects, see AliAnalysisTaskARComposite
 export LOCAL_OUTPUT_HISTOGRAMS=$(
     cat <<'EOF'
 [kRECO]fEventControlHistograms[kCEN][kBEFORE]
@@ -50,10 +55,39 @@ export LOCAL_OUTPUT_HISTOGRAMS=$(
 EOF
 )
 
+# when set to 1, use a single composite wagon for all centrality bins which
+# does event and track selection only once per event, instead of four
+# AliAnalysisTaskAR wagons per centrality bin, outputs are named like those of
+# the AliAnalysisTaskAR wagons with the suffix _Composite
+# when set to 2, use both, so ValidateComposite.C can compare their results
+export USE_COMPOSITE_WAGON="0"
+# number of threads the composite wagon uses for nested loops, 0 uses all cores
+# keep at 1 when running on grid
+# nested loops work for any correlator order, their cost grows like M^(k-2),
+# e.g. 6-particle correlators at M = 200 take a few seconds per event and
+# core, see section g) of Benchmark.C
+export NESTED_LOOPS_THREADS="1"
+
 # set analysis mode
-# has to be local or grid
+# has to be local, grid or skim
+# skim runs the composite wagon over SKIM_FILE instead of the AODs
 export ANALYSIS_MODE="local"
 
+# when running locally with the composite wagon
+# if set, selected events are written into this columnar skim file, which can
+# be read again much faster with ANALYSIS_MODE="skim", e.g. when only binning,
+# weights or correlators change, ignored on grid
+export SKIM_FILE=""
+
+# when running locally
+# number of worker processes the chain is split across, outputs are merged
+# into GRID_OUTPUT_ROOT_FILE afterwards, set to 1 to run in a single process
+export LOCAL_WORKERS="1"
+# the events of all workers are balanced by number of events or bytes, where
+# bytes follows the multiplicity of the events more closely
+# has to be events or bytes
+export PARTITION_BY="events"
+
 # when runnnig on grid
 # has to be test, offline, submit, full or terminate
 # for submission, set runmode to offline